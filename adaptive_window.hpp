@@ -0,0 +1,136 @@
+/**
+ * @file adaptive_window.hpp
+ *
+ * A client-side congestion controller for ordered_send. Derecho's window_size
+ * is a fixed, per-shard limit shared by every sender; this controller instead
+ * bounds how many of *our own* requests may be outstanding, adjusting the bound
+ * from the measured reply latency (delay-based AIMD).
+ */
+
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+class AdaptiveWindow {
+public:
+    struct Sample {
+        double time_s;         // seconds since the controller was created
+        uint32_t limit;        // outstanding-request limit after the update
+        double latency_us;     // smoothed reply latency at the update
+    };
+
+private:
+    const double target_latency_ns;
+    const uint32_t min_limit;
+    const uint32_t max_limit;
+    // multiplicative decrease factor applied when latency exceeds the target
+    const double beta;
+    // weight of a new sample in the smoothed latency
+    const double ewma_weight;
+
+    double limit;
+    double smoothed_latency_ns;
+    // replies left until the current epoch ends; at most one decrease per epoch
+    uint32_t epoch_remaining;
+    bool decreased_this_epoch;
+
+    std::chrono::steady_clock::time_point start_time;
+    std::vector<Sample> trace;
+
+    void record() {
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+        trace.push_back({elapsed, get_limit(), smoothed_latency_ns / 1e3});
+    }
+
+public:
+    /**
+     * @param target_latency_us The reply latency the controller tries to hold
+     * @param initial_limit Outstanding-request limit to start from
+     * @param max_limit Upper bound on the limit; no point exceeding window_size
+     */
+    AdaptiveWindow(double target_latency_us, uint32_t initial_limit, uint32_t max_limit,
+                   double beta = 0.8, double ewma_weight = 0.125)
+            : target_latency_ns(target_latency_us * 1e3),
+              min_limit(1),
+              max_limit(std::max(max_limit, 1u)),
+              beta(beta),
+              ewma_weight(ewma_weight),
+              limit(std::clamp(initial_limit, 1u, std::max(max_limit, 1u))),
+              smoothed_latency_ns(0.0),
+              epoch_remaining(get_limit()),
+              decreased_this_epoch(false),
+              start_time(std::chrono::steady_clock::now()) {
+        record();
+    }
+
+    uint32_t get_limit() const {
+        return static_cast<uint32_t>(limit);
+    }
+
+    double get_smoothed_latency_us() const {
+        return smoothed_latency_ns / 1e3;
+    }
+
+    /**
+     * Feeds the latency of one completed request into the controller.
+     * Below the target the limit grows by about one per window of replies
+     * (additive increase); above it the limit shrinks by beta, at most once
+     * per window so that a single burst of slow replies is not punished twice.
+     */
+    void on_reply(uint64_t latency_ns) {
+        if(smoothed_latency_ns == 0.0) {
+            smoothed_latency_ns = latency_ns;
+        } else {
+            smoothed_latency_ns += ewma_weight * (latency_ns - smoothed_latency_ns);
+        }
+
+        uint32_t old_limit = get_limit();
+        if(smoothed_latency_ns > target_latency_ns) {
+            if(!decreased_this_epoch) {
+                limit = std::max<double>(min_limit, limit * beta);
+                decreased_this_epoch = true;
+            }
+        } else {
+            limit = std::min<double>(max_limit, limit + 1.0 / limit);
+        }
+
+        if(--epoch_remaining == 0) {
+            epoch_remaining = get_limit();
+            decreased_this_epoch = false;
+        }
+        if(get_limit() != old_limit) {
+            record();
+        }
+    }
+
+    /**
+     * Writes the limit trace as "time_s limit latency_us" lines.
+     */
+    void write_trace(const std::string& filename) {
+        record();
+        std::ofstream fout(filename);
+        for(const Sample& s : trace) {
+            fout << std::fixed << s.time_s << " " << s.limit << " " << s.latency_us << std::endl;
+        }
+    }
+
+    uint32_t min_seen_limit() const {
+        uint32_t res = max_limit;
+        for(const Sample& s : trace) {
+            res = std::min(res, s.limit);
+        }
+        return res;
+    }
+
+    uint32_t max_seen_limit() const {
+        uint32_t res = min_limit;
+        for(const Sample& s : trace) {
+            res = std::max(res, s.limit);
+        }
+        return res;
+    }
+};
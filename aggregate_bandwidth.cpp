@@ -18,6 +18,19 @@ double aggregate_bandwidth(std::vector<uint32_t> members, uint32_t node_id,
     return total_bw;  // 吞吐量不需要计算成平均值
 }
 
+std::vector<double> gather_results(std::vector<uint32_t> members, uint32_t node_id,
+                                   double value) {
+    OneResultSST sst(sst::SSTParams(members, node_id));
+    sst.bw[sst.get_local_index()] = value;
+    sst.put();
+    sst.sync_with_members();
+    std::vector<double> results;
+    for(unsigned int i = 0; i < members.size(); ++i) {
+        results.push_back(sst.bw[i]);
+    }
+    return results;
+}
+
 // std::pair<double, double> aggregate_bandwidth(std::vector<uint32_t> members, uint32_t node_id,
 //                            std::pair<double, double> bw) {
 //     TwoResultSST sst(sst::SSTParams(members, node_id));
@@ -25,5 +25,9 @@ public:
 double aggregate_bandwidth(std::vector<uint32_t> members, uint32_t node_rank,
                            double bw);
 
+// collects one value from every member, indexed by rank
+std::vector<double> gather_results(std::vector<uint32_t> members, uint32_t node_id,
+                                   double value);
+
 // std::pair<double, double> aggregate_bandwidth(std::vector<uint32_t> members, uint32_t node_rank,
 //                                               std::pair<double, double> bw);
@@ -3,11 +3,18 @@
  * 1. the number of nodes 2. the number of senders (all sending, half nodes sending, one sending)
  * 3. message size 4. window size 5. number of messages sent per sender
  * 6. delivery mode (atomic multicast or unordered)
+ * Optionally, senders fill each message with a seeded pattern and a CRC32C checksum,
+ * and receivers verify it upon delivery; the time spent doing so is reported.
+ * Optionally, senders also stamp each message with their clock, and receivers record
+ * the one-way delivery latency from every sender, corrected by an estimate of the
+ * offset between the two nodes' clocks
  * The test waits for every node to join and then each sender starts sending messages continuously
  * in the only subgroup that consists of all the nodes
  * Upon completion, the results are appended to file data_derecho_bw on the leader
  */
+#include <algorithm>
 #include <chrono>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <map>
@@ -20,6 +27,8 @@
 #include "aggregate_bandwidth.hpp"
 #include "log_results.hpp"
 #include "partial_senders_allocator.hpp"
+#include "payload_checksum.hpp"
+#include "clock_offset.hpp"
 
 using std::cout;
 using std::endl;
@@ -28,6 +37,10 @@ using std::vector;
 
 using namespace derecho;
 
+// bits of the payload_mode argument
+const uint32_t PAYLOAD_CHECKSUM = 1;
+const uint32_t PAYLOAD_TIMESTAMP = 2;
+
 struct exp_result {
     uint32_t num_nodes;
     uint32_t num_senders_selector;
@@ -35,13 +48,19 @@ struct exp_result {
     unsigned int window_size;
     uint32_t num_messages;
     uint32_t delivery_mode;
+    uint32_t payload_mode;
     double bw;
+    double fill_ns_per_msg;
+    double verify_ns_per_msg;
+    uint64_t num_errors;
 
     void print(std::ofstream& fout) {
         fout << num_nodes << " " << num_senders_selector << " "
              << max_msg_size << " " << window_size << " "
              << num_messages << " " << delivery_mode << " "
-             << bw << endl;
+             << payload_mode << " " << bw << " "
+             << fill_ns_per_msg << " " << verify_ns_per_msg << " "
+             << num_errors << endl;
     }
 };
 
@@ -58,7 +77,7 @@ int main(int argc, char* argv[]) {
 
     if((argc - dashdash_pos) < 5) {
         cout << "Invalid command line arguments." << endl;
-        cout << "USAGE: " << argv[0] << " [ derecho-config-list -- ] num_nodes, sender_selector (0 - all senders, 1 - half senders, 2 - one sender), num_messages, delivery_mode (0 - ordered mode, 1 - unordered mode) [proc_name]" << endl;
+        cout << "USAGE: " << argv[0] << " [ derecho-config-list -- ] num_nodes, sender_selector (0 - all senders, 1 - half senders, 2 - one sender), num_messages, delivery_mode (0 - ordered mode, 1 - unordered mode) [payload_mode (bitmask: 1 - fill and check a CRC32C per message, 2 - measure one-way latency) [proc_name]]" << endl;
         std::cout << "Note: proc_name sets the process's name as displayed in ps and pkill commands, default is " DEFAULT_PROC_NAME << std::endl;
         return -1;
     }
@@ -68,6 +87,9 @@ int main(int argc, char* argv[]) {
     const uint32_t num_senders_selector = std::stoi(argv[dashdash_pos + 2]);
     const uint32_t num_messages = std::stoi(argv[dashdash_pos + 3]);
     const uint32_t delivery_mode = std::stoi(argv[dashdash_pos + 4]);
+    const uint32_t payload_mode = dashdash_pos + 5 < argc ? std::stoi(argv[dashdash_pos + 5]) : 0;
+    const bool verify_payload = payload_mode & PAYLOAD_CHECKSUM;
+    const bool timestamp_payload = payload_mode & PAYLOAD_TIMESTAMP;
     // Convert this integer to a more readable enum value
     const PartialSendMode senders_mode = num_senders_selector == 0
                                                  ? PartialSendMode::ALL_SENDERS
@@ -75,8 +97,8 @@ int main(int argc, char* argv[]) {
                                                             ? PartialSendMode::HALF_SENDERS
                                                             : PartialSendMode::ONE_SENDER);
 
-    if(dashdash_pos + 5 < argc) {
-        pthread_setname_np(pthread_self(), argv[dashdash_pos + 5]);
+    if(dashdash_pos + 6 < argc) {
+        pthread_setname_np(pthread_self(), argv[dashdash_pos + 6]);
     } else {
         pthread_setname_np(pthread_self(), DEFAULT_PROC_NAME);
     }
@@ -99,14 +121,58 @@ int main(int argc, char* argv[]) {
 
     // variable 'done' tracks the end of the test
     volatile bool done = false;
+    // payload verification state, only touched by the delivery thread until 'done' is set
+    uint64_t verify_ns = 0;
+    uint64_t num_errors = 0;
+    std::map<uint32_t, uint64_t> next_seq;
+    // one-way latency state, created once the group exists
+    struct LatencyStats {
+        uint64_t count = 0;
+        double sum_ns = 0.0;
+        int64_t max_ns = 0;
+    };
+    std::unique_ptr<ClockOffsetEstimator> clock_offsets;
+    std::map<uint32_t, LatencyStats> latency_by_sender;
     // callback into the application code at each message delivery
     auto stability_callback = [&done,
+                               &verify_ns,
+                               &num_errors,
+                               &next_seq,
+                               &clock_offsets,
+                               &latency_by_sender,
+                               verify_payload,
+                               timestamp_payload,
+                               delivery_mode,
                                total_num_messages,
                                num_delivered = 0u](uint32_t subgroup,
                                                    uint32_t sender_id,
                                                    long long int index,
                                                    std::optional<std::pair<uint8_t*, long long int>> data,
                                                    persistent::version_t ver) mutable {
+        if(verify_payload && data) {
+            auto verify_start = std::chrono::steady_clock::now();
+            PayloadHeader header;
+            bool ok = payload_checksum::verify(data->first, data->second, header);
+            // in ordered mode each sender's messages must also arrive in sequence
+            if(ok && delivery_mode == 0) {
+                ok = header.seq == next_seq[sender_id]++;
+            }
+            if(!ok) {
+                ++num_errors;
+            }
+            verify_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - verify_start).count();
+        }
+        if(timestamp_payload && data && clock_offsets) {
+            int64_t delivery_time = ClockOffsetEstimator::now_ns();
+            PayloadHeader header;
+            std::memcpy(&header, data->first, sizeof(header));
+            // convert the sender's clock reading to this node's clock
+            int64_t latency = delivery_time - (header.send_time_ns - clock_offsets->offset_ns(sender_id));
+            LatencyStats& stats = latency_by_sender[sender_id];
+            ++stats.count;
+            stats.sum_ns += latency;
+            stats.max_ns = std::max(stats.max_ns, latency);
+        }
         // Count the total number of messages delivered
         ++num_delivered;
         // Check for completion
@@ -135,17 +201,46 @@ int main(int argc, char* argv[]) {
     uint32_t node_rank = group.get_my_rank();
 
     long long unsigned int max_msg_size = getConfUInt64(CONF_SUBGROUP_DEFAULT_MAX_PAYLOAD_SIZE);
+    if(payload_mode && max_msg_size < sizeof(PayloadHeader)) {
+        cout << "max_payload_size is too small to hold the payload header" << endl;
+        return -1;
+    }
 
+    uint64_t fill_ns = 0;
     // this function sends all the messages
     auto send_all = [&]() {
         Replicated<RawObject>& raw_subgroup = group.get_subgroup<RawObject>();
         for(uint i = 0; i < num_messages; ++i) {
             // the lambda function writes the message contents into the provided memory buffer
-            // in this case, we do not touch the memory region
-            raw_subgroup.send(max_msg_size, [](uint8_t* buf) {});
+            if(payload_mode) {
+                raw_subgroup.send(max_msg_size, [&](uint8_t* buf) {
+                    if(verify_payload) {
+                        auto fill_start = std::chrono::steady_clock::now();
+                        payload_checksum::fill(buf, max_msg_size, members_order[node_rank], i);
+                        fill_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - fill_start).count();
+                    }
+                    if(timestamp_payload) {
+                        PayloadHeader header{i, members_order[node_rank], 0, 0};
+                        if(verify_payload) {
+                            std::memcpy(&header, buf, sizeof(header));
+                        }
+                        header.send_time_ns = ClockOffsetEstimator::now_ns();
+                        std::memcpy(buf, &header, sizeof(header));
+                    }
+                });
+            } else {
+                // in this case, we do not touch the memory region
+                raw_subgroup.send(max_msg_size, [](uint8_t* buf) {});
+            }
         }
     };
 
+    if(timestamp_payload) {
+        // estimate clock offsets before any message is sent; keeps refreshing them in the background
+        clock_offsets = std::make_unique<ClockOffsetEstimator>(members_order, members_order[node_rank]);
+        group.barrier_sync();
+    }
+
     // start timer
     auto start_time = std::chrono::steady_clock::now();
     // send all messages or skip if not a sender
@@ -175,13 +270,58 @@ int main(int argc, char* argv[]) {
     } else {
         bw = (max_msg_size * num_messages + 0.0) / nanoseconds_elapsed;
     }
+    // per-message cost of the payload checks, as measured on this node
+    double fill_ns_per_msg = 0.0;
+    double verify_ns_per_msg = 0.0;
+    if(verify_payload) {
+        fill_ns_per_msg = fill_ns / (num_messages + 0.0);
+        verify_ns_per_msg = verify_ns / (total_num_messages + 0.0);
+        cout << "fill+checksum ns/msg: " << fill_ns_per_msg
+             << " verify ns/msg: " << verify_ns_per_msg
+             << " (" << (fill_ns + verify_ns) / (nanoseconds_elapsed + 0.0) * 100 << "% of run time)"
+             << " errors: " << num_errors << endl;
+    }
+    double mean_latency_us = 0.0;
+    if(timestamp_payload) {
+        // one line per (sender, receiver) pair delivered at this node
+        std::ofstream fout("data_one_way_latency_" + std::to_string(node_rank));
+        uint64_t total_count = 0;
+        double total_sum_ns = 0.0;
+        for(const auto& [sender_id, stats] : latency_by_sender) {
+            fout << sender_id << " " << members_order[node_rank] << " " << stats.count << " "
+                 << stats.sum_ns / stats.count / 1e3 << " " << stats.max_ns / 1e3 << endl;
+            cout << "sender: " << sender_id << " avg one-way latency(us): " << stats.sum_ns / stats.count / 1e3
+                 << " max: " << stats.max_ns / 1e3 << " clock offset(us): " << clock_offsets->offset_ns(sender_id) / 1e3 << endl;
+            total_count += stats.count;
+            total_sum_ns += stats.sum_ns;
+        }
+        mean_latency_us = total_count ? total_sum_ns / total_count / 1e3 : 0.0;
+        clock_offsets.reset();
+    }
     // aggregate bandwidth from all nodes
     double avg_bw = aggregate_bandwidth(members_order, members_order[node_rank], bw);
+    if(timestamp_payload) {
+        // the receiver with the highest mean one-way latency is the slow member
+        std::vector<double> latencies = gather_results(members_order, members_order[node_rank], mean_latency_us);
+        if(node_rank == 0) {
+            std::ofstream fout("data_one_way_latency", std::ofstream::app);
+            uint32_t slowest = 0;
+            for(uint32_t i = 0; i < latencies.size(); ++i) {
+                fout << members_order[i] << " " << latencies[i] << " ";
+                if(latencies[i] > latencies[slowest]) {
+                    slowest = i;
+                }
+            }
+            fout << endl;
+            cout << "slowest receiver: " << members_order[slowest] << " mean one-way latency(us): " << latencies[slowest] << endl;
+        }
+    }
     // log the result at the leader node
     if(node_rank == 0) {
         log_results(exp_result{num_nodes, num_senders_selector, max_msg_size,
                                getConfUInt32(CONF_SUBGROUP_DEFAULT_WINDOW_SIZE), num_messages,
-                               delivery_mode, avg_bw},
+                               delivery_mode, payload_mode, avg_bw,
+                               fill_ns_per_msg, verify_ns_per_msg, num_errors},
                     "data_derecho_bw");
     }
 
@@ -0,0 +1,114 @@
+#include <limits>
+
+#include "clock_offset.hpp"
+
+// How long to keep polling after seeing a peer's ping, so that the rest of
+// its exchange gets prompt answers instead of waiting out the idle sleep
+static const std::chrono::milliseconds busy_window(10);
+static const std::chrono::microseconds idle_sleep(100);
+// Peers that do not answer a round within this time are skipped for that round
+static const std::chrono::milliseconds round_timeout(100);
+
+ClockOffsetEstimator::ClockOffsetEstimator(const std::vector<uint32_t>& members, uint32_t node_id,
+                                           int rounds_per_exchange, int period_ms)
+        : members(members),
+          sst(std::make_unique<ClockSST>(sst::SSTParams(members, node_id), members.size())),
+          my_index(sst->get_local_index()),
+          rounds_per_exchange(rounds_per_exchange),
+          period(period_ms),
+          offsets(new std::atomic<int64_t>[members.size()]),
+          stopped(false) {
+    for(uint32_t i = 0; i < members.size(); ++i) {
+        member_index[members[i]] = i;
+        offsets[i] = 0;
+        sst->pong_seq[my_index][i] = 0;
+    }
+    sst->ping_seq[my_index] = 0;
+    sst->put();
+    sst->sync_with_members();
+    run_exchange();
+    exchange_thread = std::thread([this]() {
+        auto next_exchange = std::chrono::steady_clock::now() + period;
+        while(!stopped) {
+            auto now = std::chrono::steady_clock::now();
+            if(now >= next_exchange) {
+                run_exchange();
+                next_exchange = std::chrono::steady_clock::now() + period;
+            } else {
+                answer_pings();
+                if(now - last_ping_seen > busy_window) {
+                    std::this_thread::sleep_for(idle_sleep);
+                }
+            }
+        }
+    });
+}
+
+ClockOffsetEstimator::~ClockOffsetEstimator() {
+    stop();
+}
+
+void ClockOffsetEstimator::stop() {
+    if(!exchange_thread.joinable()) {
+        return;
+    }
+    stopped = true;
+    exchange_thread.join();
+    sst->sync_with_members();
+}
+
+void ClockOffsetEstimator::answer_pings() {
+    bool answered = false;
+    for(uint32_t i = 0; i < members.size(); ++i) {
+        if(i == my_index) {
+            continue;
+        }
+        uint64_t seq = sst->ping_seq[i];
+        if(seq != sst->pong_seq[my_index][i]) {
+            sst->pong_time[my_index][i] = now_ns();
+            sst->pong_seq[my_index][i] = seq;
+            answered = true;
+        }
+    }
+    if(answered) {
+        sst->put();
+        last_ping_seen = std::chrono::steady_clock::now();
+    }
+}
+
+void ClockOffsetEstimator::run_exchange() {
+    const uint32_t num_members = members.size();
+    std::vector<int64_t> best_rtt(num_members, std::numeric_limits<int64_t>::max());
+    std::vector<int64_t> best_offset(num_members, 0);
+    for(int round = 0; round < rounds_per_exchange && !stopped; ++round) {
+        sst->ping_seq[my_index] = ++ping_seq;
+        int64_t send_time = now_ns();
+        sst->put();
+        std::vector<bool> answered(num_members, false);
+        answered[my_index] = true;
+        uint32_t num_answered = 1;
+        auto deadline = std::chrono::steady_clock::now() + round_timeout;
+        while(num_answered < num_members && std::chrono::steady_clock::now() < deadline) {
+            // peers may be running their own exchange at the same time
+            answer_pings();
+            for(uint32_t j = 0; j < num_members; ++j) {
+                if(answered[j] || sst->pong_seq[j][my_index] != ping_seq) {
+                    continue;
+                }
+                int64_t recv_time = now_ns();
+                int64_t rtt = recv_time - send_time;
+                if(rtt < best_rtt[j]) {
+                    best_rtt[j] = rtt;
+                    best_offset[j] = sst->pong_time[j][my_index] - (send_time + recv_time) / 2;
+                }
+                answered[j] = true;
+                ++num_answered;
+            }
+        }
+    }
+    for(uint32_t j = 0; j < num_members; ++j) {
+        if(j != my_index && best_rtt[j] != std::numeric_limits<int64_t>::max()) {
+            offsets[j].store(best_offset[j], std::memory_order_relaxed);
+        }
+    }
+}
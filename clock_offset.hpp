@@ -0,0 +1,85 @@
+#pragma once
+
+#include <derecho/sst/sst.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <thread>
+#include <vector>
+
+/**
+ * SST used to exchange clock readings, one row per member.
+ * A member starts a round by incrementing its ping_seq; every other member j
+ * answers by writing its clock into pong_time[j][i] and then copying the round
+ * number into pong_seq[j][i].
+ */
+class ClockSST : public sst::SST<ClockSST> {
+public:
+    sst::SSTField<uint64_t> ping_seq;
+    sst::SSTFieldVector<int64_t> pong_time;
+    sst::SSTFieldVector<uint64_t> pong_seq;
+    ClockSST(const sst::SSTParams& params, uint32_t num_members)
+            : SST<ClockSST>(this, params),
+              pong_time(num_members),
+              pong_seq(num_members) {
+        // pong_time precedes pong_seq in the row, so it is written first
+        SSTInit(ping_seq, pong_time, pong_seq);
+    }
+};
+
+/**
+ * Estimates the offset of every member's clock relative to this node's,
+ * Cristian-style: offset = t_peer - (t_send + t_recv) / 2, keeping the sample
+ * with the smallest round trip out of each exchange. One exchange runs in the
+ * constructor, then a background thread repeats it every period_ms.
+ */
+class ClockOffsetEstimator {
+    std::vector<uint32_t> members;
+    std::map<uint32_t, uint32_t> member_index;
+    std::unique_ptr<ClockSST> sst;
+    uint32_t my_index;
+    const int rounds_per_exchange;
+    const std::chrono::milliseconds period;
+
+    std::unique_ptr<std::atomic<int64_t>[]> offsets;
+    std::atomic<bool> stopped;
+    std::thread exchange_thread;
+
+    uint64_t ping_seq = 0;
+    std::chrono::steady_clock::time_point last_ping_seen;
+
+    void answer_pings();
+    void run_exchange();
+
+public:
+    /**
+     * Must be constructed by every member, as it synchronizes with them.
+     * @param members The node ids of all members, in rank order
+     * @param node_id This node's id
+     */
+    ClockOffsetEstimator(const std::vector<uint32_t>& members, uint32_t node_id,
+                         int rounds_per_exchange = 8, int period_ms = 1000);
+    ~ClockOffsetEstimator();
+
+    /**
+     * Stops the background exchanges. Every member must call this (or destroy
+     * its estimator), since it waits until no member writes to the SST anymore.
+     */
+    void stop();
+
+    /**
+     * @return The latest estimate of (node_id's clock - this node's clock), in
+     * nanoseconds of std::chrono::steady_clock
+     */
+    int64_t offset_ns(uint32_t node_id) const {
+        return offsets[member_index.at(node_id)].load(std::memory_order_relaxed);
+    }
+
+    static int64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now().time_since_epoch())
+                .count();
+    }
+};
@@ -18,11 +18,17 @@
 #include <string>
 #include <vector>
 #include <cassert>
+#include <cstring>
 #include <thread>
+#include <type_traits>
+#include <deque>
+#include <chrono>
+#include <future>
 
 #include <derecho/conf/conf.hpp>
 #include <derecho/core/derecho.hpp>
 #include "sample_objects.hpp"
+#include "adaptive_window.hpp"
 // #include "aggregate_bandwidth.hpp"
 
 using derecho::ExternalCaller;
@@ -34,26 +40,47 @@ using std::endl;
 const int num_clients = 8;          // clients数目
 const int shard_size = 2;           // 也就是replica factor
 const double test_time = 10.0;      // 测试时间
-// const int msg_size = 16;
+const std::size_t msg_size = 0;    // 消息大小（0表示使用Foo，否则使用FooFixed<msg_size>），也可在命令行 -- 之后指定
+const bool adaptive_sender = false;         // 是否根据回复延迟自适应调整未完成请求数
+const double target_latency_us = 500.0;     // 自适应模式下的目标延迟
+const uint32_t initial_limit = 8;           // 自适应模式下的初始未完成请求数上限
 
 
-int main(int argc, char** argv) {
-    // 1. 创建Group
-    // Read configurations from the command line options as well as the default config file
-    derecho::Conf::initialize(argc, argv);
+/**
+ * The argument change_state is called with, built once outside the send loop.
+ */
+template <typename Object>
+auto make_value(uint32_t node_rank) {
+    if constexpr(std::is_same_v<Object, Foo>) {
+        return static_cast<uint64_t>(node_rank);
+    } else {
+        typename Object::payload_t value;
+        value.fill(static_cast<uint8_t>(node_rank));
+        return value;
+    }
+}
 
+template <typename Object>
+int run_test() {
+    // 1. 创建Group
     //Define subgroup membership using the default subgroup allocator function
     //Each Replicated type will have one subgroup and one shard, with three members in the shard
     derecho::SubgroupInfo subgroup_function {derecho::DefaultSubgroupAllocator({
-        {std::type_index(typeid(Foo)), derecho::one_subgroup_policy(derecho::fixed_even_shards(num_clients / shard_size, shard_size))}
+        {std::type_index(typeid(Object)), derecho::one_subgroup_policy(derecho::fixed_even_shards(num_clients / shard_size, shard_size))}
         // {std::type_index(typeid(Bar)), derecho::one_subgroup_policy(derecho::fixed_even_shards(num_clients / shard_size, shard_size))},  // TODO node数量可能要大于replica数量，可能需要改shared数目
     })};
 
     //Each replicated type needs a factory; this can be used to supply constructor arguments
     //for the subgroup's initial state. These must take a PersistentRegistry* argument, but
     //in this case we ignore it because the replicated objects aren't persistent.
-    auto foo_factory = [](persistent::PersistentRegistry*,derecho::subgroup_id_t) { return std::make_unique<Foo>(-1); };
-    derecho::Group<Foo> group(derecho::UserMessageCallbacks{}, subgroup_function, {},
+    auto foo_factory = [](persistent::PersistentRegistry*,derecho::subgroup_id_t) {
+        if constexpr(std::is_same_v<Object, Foo>) {
+            return std::make_unique<Foo>(-1);
+        } else {
+            return std::make_unique<Object>();
+        }
+    };
+    derecho::Group<Object> group(derecho::UserMessageCallbacks{}, subgroup_function, {},
                                         std::vector<derecho::view_upcall_t>{},
                                         foo_factory);
     
@@ -65,11 +92,11 @@ int main(int argc, char** argv) {
     cout << "Finished constructing/joining Group" << endl;
     auto members_order = group.get_members();
     uint32_t node_rank = group.get_my_rank();
-    Replicated<Foo>& rpc_handle = group.get_subgroup<Foo>();
+    Replicated<Object>& rpc_handle = group.get_subgroup<Object>();
+    const auto new_value = make_value<Object>(node_rank);
 
     // 2. 发送消息的函数
     auto send_one = [&]() {
-        int new_value = node_rank;
         // derecho::rpc::QueryResults<void> void_future = rpc_handle.ordered_send<RPC_NAME(change_state)>(new_value);
         // derecho::rpc::QueryResults<void>::ReplyMap& sent_nodes = void_future.get();
         // for(const node_id_t& node : sent_nodes);
@@ -90,13 +117,61 @@ int main(int argc, char** argv) {
         // cout << endl;
     };
 
+    // 2'. 自适应发送：自己限制未完成请求数，而不是全部堵在Derecho的window上
+    struct InFlight {
+        derecho::rpc::QueryResults<bool> results;
+        std::chrono::steady_clock::time_point send_time;
+    };
+    std::deque<InFlight> in_flight;
+    AdaptiveWindow window(target_latency_us, initial_limit,
+                          derecho::getConfUInt32(CONF_SUBGROUP_DEFAULT_WINDOW_SIZE));
+
+    // A request is complete once every member of the shard has replied
+    auto is_complete = [](derecho::rpc::QueryResults<bool>& results) {
+        auto reply_map = results.wait(std::chrono::nanoseconds(0));
+        if(!reply_map) {
+            return false;
+        }
+        for(auto& reply_pair : reply_map->get()) {
+            if(reply_pair.second.wait_for(std::chrono::nanoseconds(0)) != std::future_status::ready) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    // Ordered sends complete in order, so only the front of the queue needs checking
+    auto harvest_replies = [&]() {
+        while(!in_flight.empty() && is_complete(in_flight.front().results)) {
+            auto latency = std::chrono::steady_clock::now() - in_flight.front().send_time;
+            window.on_reply(std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count());
+            in_flight.pop_front();
+        }
+    };
+
+    // Sends a burst filling the free part of the window; returns the number of requests sent
+    auto send_adaptive = [&]() -> uint64_t {
+        harvest_replies();
+        uint64_t sent = 0;
+        while(in_flight.size() < window.get_limit()) {
+            in_flight.push_back({rpc_handle.ordered_send<RPC_NAME(change_state)>(new_value),
+                                 std::chrono::steady_clock::now()});
+            ++sent;
+        }
+        return sent;
+    };
+
     // 3. throughput测试逻辑
     group.barrier_sync();
     auto start_time = std::chrono::steady_clock::now();
     uint64_t cnt = 0, nanoseconds_elapsed;
     do {
-        cnt ++;
-        send_one();
+        if(adaptive_sender) {
+            cnt += send_adaptive();
+        } else {
+            cnt ++;
+            send_one();
+        }
         // if(cnt % 100 == 0) cout << cnt << endl;
         nanoseconds_elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_time).count();
     } while(nanoseconds_elapsed < test_time * 1e9);
@@ -104,6 +179,17 @@ int main(int argc, char** argv) {
     double bw = (cnt + 0.0) / nanoseconds_elapsed *1e9;
     cout <<  "Time is up! bw: " << bw << endl;
 
+    if(adaptive_sender) {
+        // 等待剩余请求完成，并记录上限变化
+        while(!in_flight.empty()) {
+            harvest_replies();
+        }
+        cout << "limit range: [" << window.min_seen_limit() << ", " << window.max_seen_limit()
+             << "], final limit: " << window.get_limit()
+             << ", smoothed latency(us): " << window.get_smoothed_latency_us() << endl;
+        window.write_trace("results/limit_" + std::to_string(node_rank) + ".txt");
+    }
+
     std::ofstream file;
     file.open("results/bw_" + std::to_string(node_rank) + ".txt");
     file << std::fixed << bw << endl;
@@ -123,3 +209,40 @@ int main(int argc, char** argv) {
     group.leave();
     return 0;
 }
+
+/**
+ * Maps each payload size in the ladder to the test instantiated for it.
+ */
+template <std::size_t... Sizes>
+std::map<std::size_t, int (*)()> make_dispatch_table(std::index_sequence<Sizes...>) {
+    return {{0, &run_test<Foo>}, {Sizes, &run_test<FooFixed<Sizes>>}...};
+}
+
+int main(int argc, char** argv) {
+    int dashdash_pos = argc - 1;
+    while(dashdash_pos > 0) {
+        if(strcmp(argv[dashdash_pos], "--") == 0) {
+            break;
+        }
+        dashdash_pos--;
+    }
+    std::size_t size = msg_size;
+    if(dashdash_pos > 0 && dashdash_pos + 1 < argc) {
+        size = std::stoul(argv[dashdash_pos + 1]);
+    }
+
+    // Read configurations from the command line options as well as the default config file
+    derecho::Conf::initialize(argc, argv);
+
+    const auto dispatch_table = make_dispatch_table(payload_size_ladder{});
+    auto test = dispatch_table.find(size);
+    if(test == dispatch_table.end()) {
+        cout << "Unsupported msg_size " << size << ", choose one of:";
+        for(const auto& entry : dispatch_table) {
+            cout << " " << entry.first;
+        }
+        cout << endl;
+        return -1;
+    }
+    return test->second();
+}
@@ -0,0 +1,185 @@
+/**
+ * @file payload_checksum.hpp
+ *
+ * Seeded payload patterns and CRC32C checksums for verifying raw sends.
+ * Each message starts with a PayloadHeader; the rest of the buffer is filled
+ * from a pattern seeded by (sender, seq) and covered by a CRC32C stored in the
+ * header. The CRC uses the SSE4.2 crc32 instruction when the CPU has it and
+ * falls back to a table-driven implementation otherwise.
+ */
+
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+struct PayloadHeader {
+    uint64_t seq;
+    uint32_t sender;
+    uint32_t crc;
+    // sender's steady_clock reading, not covered by crc
+    int64_t send_time_ns;
+};
+
+namespace payload_checksum {
+
+inline std::array<uint32_t, 256> make_crc32c_table() {
+    std::array<uint32_t, 256> table{};
+    for(uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc = i;
+        for(int bit = 0; bit < 8; ++bit) {
+            crc = (crc >> 1) ^ (0x82F63B78u & (0u - (crc & 1u)));
+        }
+        table[i] = crc;
+    }
+    return table;
+}
+
+inline uint32_t crc32c_software(uint32_t crc, const uint8_t* data, std::size_t len) {
+    static const std::array<uint32_t, 256> table = make_crc32c_table();
+    for(std::size_t i = 0; i < len; ++i) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+/**
+ * Multiplies two polynomials modulo the (reflected) CRC32C polynomial.
+ */
+inline uint32_t multmodp(uint32_t a, uint32_t b) {
+    uint32_t m = 1u << 31;
+    uint32_t p = 0;
+    while(true) {
+        if(a & m) {
+            p ^= b;
+            if((a & (m - 1)) == 0) {
+                break;
+            }
+        }
+        m >>= 1;
+        b = (b & 1) ? (b >> 1) ^ 0x82F63B78u : b >> 1;
+    }
+    return p;
+}
+
+/**
+ * Returns x^(8 * len) modulo the CRC32C polynomial, i.e. the factor that
+ * appends len zero bytes to a CRC register.
+ */
+inline uint32_t zeros_operator(std::size_t len) {
+    uint32_t p = 1u << 31;     // x^0
+    uint32_t x2n = 1u << 23;   // x^8
+    while(len > 0) {
+        if(len & 1) {
+            p = multmodp(x2n, p);
+        }
+        x2n = multmodp(x2n, x2n);
+        len >>= 1;
+    }
+    return p;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2"))) inline uint64_t crc32c_sse42_stream(uint64_t crc, const uint8_t* data, std::size_t len) {
+    // the buffer is not necessarily 8-byte aligned
+    for(std::size_t i = 0; i < len; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        crc = _mm_crc32_u64(crc, word);
+    }
+    return crc;
+}
+
+__attribute__((target("sse4.2"))) inline uint32_t crc32c_sse42(uint32_t crc, const uint8_t* data, std::size_t len) {
+    // crc32q has a latency of 3 cycles but a throughput of 1 per cycle, so
+    // large buffers are split into three independent lanes whose CRCs are
+    // merged afterwards by shifting the earlier lanes past the later ones
+    constexpr std::size_t lane_size = 8192;
+    static const uint32_t shift_one_lane = zeros_operator(lane_size);
+    static const uint32_t shift_two_lanes = zeros_operator(2 * lane_size);
+    while(len >= 3 * lane_size) {
+        uint64_t crc0 = crc, crc1 = 0, crc2 = 0;
+        for(std::size_t i = 0; i < lane_size; i += 8) {
+            uint64_t w0, w1, w2;
+            std::memcpy(&w0, data + i, sizeof(w0));
+            std::memcpy(&w1, data + lane_size + i, sizeof(w1));
+            std::memcpy(&w2, data + 2 * lane_size + i, sizeof(w2));
+            crc0 = _mm_crc32_u64(crc0, w0);
+            crc1 = _mm_crc32_u64(crc1, w1);
+            crc2 = _mm_crc32_u64(crc2, w2);
+        }
+        crc = multmodp(shift_two_lanes, static_cast<uint32_t>(crc0))
+              ^ multmodp(shift_one_lane, static_cast<uint32_t>(crc1))
+              ^ static_cast<uint32_t>(crc2);
+        data += 3 * lane_size;
+        len -= 3 * lane_size;
+    }
+    std::size_t words_len = len & ~static_cast<std::size_t>(7);
+    uint32_t crc32 = static_cast<uint32_t>(crc32c_sse42_stream(crc, data, words_len));
+    for(std::size_t i = words_len; i < len; ++i) {
+        crc32 = _mm_crc32_u8(crc32, data[i]);
+    }
+    return crc32;
+}
+#endif
+
+/**
+ * Computes the CRC32C (Castagnoli) of a buffer.
+ */
+inline uint32_t crc32c(const uint8_t* data, std::size_t len) {
+#if defined(__x86_64__)
+    static const bool has_sse42 = __builtin_cpu_supports("sse4.2");
+    if(has_sse42) {
+        return ~crc32c_sse42(~0u, data, len);
+    }
+#endif
+    return ~crc32c_software(~0u, data, len);
+}
+
+/**
+ * Fills the body of a message with a pattern seeded by (sender, seq),
+ * writes the header, and stores the body's checksum in it.
+ * @param buf The message buffer provided by RawObject's send
+ * @param size The size of the buffer; must be at least sizeof(PayloadHeader)
+ */
+inline void fill(uint8_t* buf, std::size_t size, uint32_t sender, uint64_t seq) {
+    uint8_t* body = buf + sizeof(PayloadHeader);
+    std::size_t body_size = size - sizeof(PayloadHeader);
+    // each word is a hash of (seed, word index) rather than the next step of a
+    // sequential generator, so the loop has no carried dependency
+    const uint64_t seed = ((static_cast<uint64_t>(sender) << 32) ^ seq) * 0x9E3779B97F4A7C15ull;
+    auto pattern_word = [seed](uint64_t index) {
+        uint64_t x = seed + index * 0xBF58476D1CE4E5B9ull;
+        return x ^ (x >> 31);
+    };
+    std::size_t i = 0;
+    for(; i + 8 <= body_size; i += 8) {
+        uint64_t word = pattern_word(i / 8);
+        std::memcpy(body + i, &word, sizeof(word));
+    }
+    uint64_t last_word = pattern_word(i / 8);
+    for(; i < body_size; ++i) {
+        body[i] = static_cast<uint8_t>(last_word >> (8 * (i % 8)));
+    }
+    PayloadHeader header{seq, sender, crc32c(body, body_size), 0};
+    std::memcpy(buf, &header, sizeof(header));
+}
+
+/**
+ * Checks a received message against the checksum in its header.
+ * @param header Receives a copy of the message header
+ * @return true if the body matches the checksum
+ */
+inline bool verify(const uint8_t* buf, std::size_t size, PayloadHeader& header) {
+    if(size < sizeof(PayloadHeader)) {
+        return false;
+    }
+    std::memcpy(&header, buf, sizeof(header));
+    return crc32c(buf + sizeof(PayloadHeader), size - sizeof(PayloadHeader)) == header.crc;
+}
+
+}  // namespace payload_checksum
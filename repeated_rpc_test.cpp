@@ -5,10 +5,15 @@
  * @author edward
  */
 
+#include <chrono>
+#include <fstream>
 #include <iostream>
+#include <vector>
 
 #include <derecho/core/derecho.hpp>
 #include "sample_objects.hpp"
+#include "reply_policy.hpp"
+#include "log_results.hpp"
 #include <derecho/conf/conf.hpp>
 
 using derecho::ExternalCaller;
@@ -16,6 +21,19 @@ using derecho::Replicated;
 using std::cout;
 using std::endl;
 
+struct reply_mode_result {
+    std::string mode;
+    uint32_t quorum_size;
+    int trials;
+    double avg_latency_us;
+    double throughput;
+
+    void print(std::ofstream& fout) {
+        fout << mode << " " << quorum_size << " " << trials << " "
+             << avg_latency_us << " " << throughput << endl;
+    }
+};
+
 int main(int argc, char** argv) {
     derecho::Conf::initialize(argc, argv);
 
@@ -35,15 +53,40 @@ int main(int argc, char** argv) {
     cout << "Finished constructing/joining Group" << endl;
 
     Replicated<FooInt>& foo_rpc_handle = group.get_subgroup<FooInt>();
-    cout << "Changing Foo's state " << trials << " times" << endl;
-    for(int count = 0; count < trials; ++count) {
-        cout << "Sending query #" << count << std::endl;
-        derecho::rpc::QueryResults<bool> results = foo_rpc_handle.ordered_send<RPC_NAME(change_state)>(count);
-        bool results_total = true;
-        for(auto& reply_pair : results.get()) {
-            cout << "Waiting for results from " << reply_pair.first << endl;
-            results_total = results_total && reply_pair.second.get();
+    const node_id_t my_id = group.get_my_id();
+    // majority of the shard
+    const uint32_t quorum_size = shard_size / 2 + 1;
+
+    // ALL and QUORUM wait on change_state's bool replies; LOCAL and NONE use the
+    // void-returning set_state, since no caller needs its return value
+    auto run_trials = [&](ReplyMode mode) {
+        group.barrier_sync();
+        cout << "Changing Foo's state " << trials << " times, waiting for " << reply_mode_name(mode) << " replies" << endl;
+        auto start_time = std::chrono::steady_clock::now();
+        for(int count = 0; count < trials; ++count) {
+            if(mode == ReplyMode::ALL || mode == ReplyMode::QUORUM) {
+                derecho::rpc::QueryResults<bool> results = foo_rpc_handle.ordered_send<RPC_NAME(change_state)>(count);
+                wait_for_replies(results, mode, my_id, quorum_size);
+            } else {
+                derecho::rpc::QueryResults<void> results = foo_rpc_handle.ordered_send<RPC_NAME(set_state)>(count);
+                wait_for_replies(results, mode, my_id);
+            }
         }
+        auto end_time = std::chrono::steady_clock::now();
+        double nanoseconds_elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - start_time).count();
+        // in NONE mode this is the cost of issuing a send, not a round trip
+        reply_mode_result result{reply_mode_name(mode),
+                                 mode == ReplyMode::QUORUM ? quorum_size : 0,
+                                 trials,
+                                 nanoseconds_elapsed / trials / 1e3,
+                                 trials / nanoseconds_elapsed * 1e9};
+        cout << "mode: " << result.mode << " avg latency(us): " << result.avg_latency_us
+             << " throughput: " << std::fixed << result.throughput << endl;
+        log_results(result, "data_rpc_reply_modes_" + std::to_string(group.get_my_rank()));
+    };
+
+    for(ReplyMode mode : {ReplyMode::ALL, ReplyMode::QUORUM, ReplyMode::LOCAL, ReplyMode::NONE}) {
+        run_trials(mode);
     }
 
     cout << "Reached end of main()" << endl;
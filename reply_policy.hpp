@@ -0,0 +1,94 @@
+/**
+ * @file reply_policy.hpp
+ *
+ * Client wait policies for ordered RPCs. By default a caller iterates over
+ * results.get() and waits for a reply from every member of the shard; these
+ * policies let the caller return earlier.
+ */
+
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <string>
+
+#include <derecho/core/derecho.hpp>
+
+enum class ReplyMode {
+    ALL,       // wait for a reply from every member of the shard
+    QUORUM,    // wait for the first k replies
+    LOCAL,     // wait until the message has been delivered at this node
+    NONE       // fire and forget
+};
+
+inline std::string reply_mode_name(ReplyMode mode) {
+    switch(mode) {
+        case ReplyMode::ALL:
+            return "all";
+        case ReplyMode::QUORUM:
+            return "quorum";
+        case ReplyMode::LOCAL:
+            return "local";
+        case ReplyMode::NONE:
+            return "none";
+    }
+    return "unknown";
+}
+
+/**
+ * Blocks according to the given policy.
+ * @param results The QueryResults returned by ordered_send
+ * @param mode The wait policy
+ * @param my_id This node's id, used by ReplyMode::LOCAL
+ * @param quorum_size Number of replies needed by ReplyMode::QUORUM; clamped to
+ *        the number of members that will reply
+ * @return The number of replies known to have arrived when the call returned
+ */
+template <typename T>
+uint32_t wait_for_replies(derecho::rpc::QueryResults<T>& results, ReplyMode mode,
+                          node_id_t my_id, uint32_t quorum_size = 1) {
+    if(mode == ReplyMode::NONE) {
+        return 0;
+    }
+    auto& reply_map = results.get();
+    if(mode == ReplyMode::ALL) {
+        uint32_t num_replies = 0;
+        for(auto& reply_pair : reply_map) {
+            reply_pair.second.wait();
+            ++num_replies;
+        }
+        return num_replies;
+    }
+    if(mode == ReplyMode::LOCAL) {
+        // This node executes its own ordered RPC upon delivery, so its local
+        // reply is ready exactly when the message has been delivered here
+        for(auto& reply_pair : reply_map) {
+            if(reply_pair.first == my_id) {
+                reply_pair.second.wait();
+                return 1;
+            }
+        }
+        return 0;
+    }
+    // ReplyMode::QUORUM: poll until the first k replies are ready
+    uint32_t num_members = 0;
+    for(auto& reply_pair : reply_map) {
+        (void)reply_pair;
+        ++num_members;
+    }
+    if(quorum_size > num_members) {
+        quorum_size = num_members;
+    }
+    uint32_t num_ready = 0;
+    while(true) {
+        num_ready = 0;
+        for(auto& reply_pair : reply_map) {
+            if(reply_pair.second.wait_for(std::chrono::nanoseconds(0)) == std::future_status::ready) {
+                ++num_ready;
+            }
+        }
+        if(num_ready >= quorum_size) {
+            return num_ready;
+        }
+    }
+}
@@ -5,9 +5,12 @@
  */
 
 #pragma once
+#include <array>
+#include <cstdint>
 #include <map>
 #include <memory>
 #include <string>
+#include <utility>
 
 #include <derecho/core/derecho.hpp>
 #include <derecho/mutils-serialization/SerializationSupport.hpp>
@@ -41,6 +44,13 @@ struct Foo : public mutils::ByteRepresentable {
         state = new_state;
         return true;
     }
+    /**
+     * Write-only variant of change_state; returns nothing so callers can
+     * choose not to wait for every replica's reply.
+     */
+    void set_state(const uint64_t& new_state) {
+        state = new_state;
+    }
 
     /**
      * Constructs a Foo with an initial value. Also needed by serialization.
@@ -50,7 +60,7 @@ struct Foo : public mutils::ByteRepresentable {
     Foo(const Foo&) = default;
 
     DEFAULT_SERIALIZATION_SUPPORT(Foo, state);
-    REGISTER_RPC_FUNCTIONS(Foo, P2P_TARGETS(read_state), ORDERED_TARGETS(read_state, change_state))
+    REGISTER_RPC_FUNCTIONS(Foo, P2P_TARGETS(read_state), ORDERED_TARGETS(read_state, change_state, set_state))
 };
 
 struct FooInt: mutils::ByteRepresentable {
@@ -67,8 +77,11 @@ struct FooInt: mutils::ByteRepresentable {
         state = new_state;
         return true;
     }
+    void set_state(int new_state) {
+        state = new_state;
+    }
 
-    REGISTER_RPC_FUNCTIONS(FooInt, P2P_TARGETS(read_state), ORDERED_TARGETS(read_state, change_state));
+    REGISTER_RPC_FUNCTIONS(FooInt, P2P_TARGETS(read_state), ORDERED_TARGETS(read_state, change_state, set_state));
     /**
      * Constructs a FooInt with an initial value.
      * @param initial_state
@@ -79,6 +92,45 @@ struct FooInt: mutils::ByteRepresentable {
     DEFAULT_SERIALIZATION_SUPPORT(FooInt, state);
 };
 
+/**
+ * Like Foo, but the state is a fixed-size payload of N bytes. A std::array of
+ * bytes is a POD type, so mutils serializes it with a single memcpy of a size
+ * known at compile time, and deserializes RPC arguments in place without
+ * allocating.
+ */
+template <std::size_t N>
+struct FooFixed : public mutils::ByteRepresentable {
+    using payload_t = std::array<uint8_t, N>;
+
+    payload_t state;
+
+    payload_t read_state() const {
+        return state;
+    }
+    bool change_state(const payload_t& new_state) {
+        if(new_state == state) {
+            return false;
+        }
+        state = new_state;
+        return true;
+    }
+    void set_state(const payload_t& new_state) {
+        state = new_state;
+    }
+
+    FooFixed() : state{} {}
+    FooFixed(const payload_t& initial_state) : state(initial_state) {}
+    FooFixed(const FooFixed&) = default;
+
+    DEFAULT_SERIALIZATION_SUPPORT(FooFixed, state);
+    REGISTER_RPC_FUNCTIONS(FooFixed, P2P_TARGETS(read_state), ORDERED_TARGETS(read_state, change_state, set_state))
+};
+
+/**
+ * The payload sizes FooFixed is instantiated for, 16B to 64KB.
+ */
+using payload_size_ladder = std::index_sequence<16, 64, 256, 1024, 4096, 16384, 65536>;
+
 /**
  * Another example replicated object, where the serializable state is not a POD.
  */
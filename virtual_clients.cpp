@@ -0,0 +1,121 @@
+/**
+ * @file virtual_clients.cpp
+ *
+ * Throughput/latency test with many logical client sessions per process.
+ * Like main.cpp, every process joins the Foo subgroup, but instead of sending
+ * from a single loop it runs num_sessions coroutine sessions on num_threads
+ * threads (see virtual_clients.hpp). Each session alternates between a random
+ * think time and one ordered_send, waiting for all replies before thinking again.
+ */
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <derecho/conf/conf.hpp>
+#include <derecho/core/derecho.hpp>
+#include "sample_objects.hpp"
+#include "virtual_clients.hpp"
+
+using derecho::Replicated;
+using std::cout;
+using std::endl;
+
+
+const int num_clients = 8;              // clients数目（按进程算）
+const int shard_size = 2;               // 也就是replica factor
+const double test_time = 10.0;          // 测试时间
+const int num_sessions = 10000;         // 每个进程的虚拟client（会话）数目
+const int num_threads = 4;              // 每个进程运行会话的线程数
+const double mean_think_time_us = 1000.0;   // 每个会话两次请求之间的平均思考时间（指数分布）
+
+struct SessionStats {
+    uint64_t num_requests = 0;
+    std::vector<uint32_t> latencies_us;
+};
+
+int main(int argc, char** argv) {
+    // 1. 创建Group
+    derecho::Conf::initialize(argc, argv);
+
+    derecho::SubgroupInfo subgroup_function {derecho::DefaultSubgroupAllocator({
+        {std::type_index(typeid(Foo)), derecho::one_subgroup_policy(derecho::fixed_even_shards(num_clients / shard_size, shard_size))}
+    })};
+
+    auto foo_factory = [](persistent::PersistentRegistry*,derecho::subgroup_id_t) { return std::make_unique<Foo>(-1); };
+    derecho::Group<Foo> group(derecho::UserMessageCallbacks{}, subgroup_function, {},
+                                        std::vector<derecho::view_upcall_t>{},
+                                        foo_factory);
+
+    cout << "Finished constructing/joining Group" << endl;
+    uint32_t node_rank = group.get_my_rank();
+    Replicated<Foo>& rpc_handle = group.get_subgroup<Foo>();
+
+    // 2. 每个会话的逻辑：思考 -> 发送 -> 等待所有回复
+    // each session writes only to its own slot, so no locking is needed
+    std::vector<SessionStats> stats(num_sessions);
+    std::chrono::steady_clock::time_point end_time;
+
+    auto session = [&](virtual_clients::Scheduler& scheduler, int session_id) -> virtual_clients::Session {
+        std::mt19937_64 rng(node_rank * num_sessions + session_id);
+        std::exponential_distribution<double> think_time_us(1.0 / mean_think_time_us);
+        SessionStats& my_stats = stats[session_id];
+        while(std::chrono::steady_clock::now() < end_time) {
+            co_await virtual_clients::SleepFor{scheduler, std::chrono::microseconds(static_cast<int64_t>(think_time_us(rng)))};
+            auto send_time = std::chrono::steady_clock::now();
+            uint64_t new_value = node_rank * num_sessions + session_id;
+            derecho::rpc::QueryResults<bool> results = rpc_handle.ordered_send<RPC_NAME(change_state)>(new_value);
+            co_await virtual_clients::AllReplies<bool>{scheduler, results};
+            auto latency = std::chrono::steady_clock::now() - send_time;
+            my_stats.latencies_us.push_back(std::chrono::duration_cast<std::chrono::microseconds>(latency).count());
+            ++my_stats.num_requests;
+        }
+    };
+
+    virtual_clients::Runtime runtime(num_threads);
+    for(int session_id = 0; session_id < num_sessions; ++session_id) {
+        runtime.spawn([&, session_id](virtual_clients::Scheduler& scheduler) { return session(scheduler, session_id); });
+    }
+
+    // 3. throughput测试逻辑
+    group.barrier_sync();
+    auto start_time = std::chrono::steady_clock::now();
+    end_time = start_time + std::chrono::nanoseconds(static_cast<int64_t>(test_time * 1e9));
+    runtime.run();
+    uint64_t nanoseconds_elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_time).count();
+
+    uint64_t cnt = 0;
+    std::vector<uint32_t> latencies_us;
+    for(SessionStats& s : stats) {
+        cnt += s.num_requests;
+        latencies_us.insert(latencies_us.end(), s.latencies_us.begin(), s.latencies_us.end());
+    }
+    std::sort(latencies_us.begin(), latencies_us.end());
+    auto percentile = [&](double p) -> uint32_t {
+        if(latencies_us.empty()) {
+            return 0;
+        }
+        return latencies_us[std::min(latencies_us.size() - 1, static_cast<std::size_t>(p * latencies_us.size()))];
+    };
+
+    double bw = (cnt + 0.0) / nanoseconds_elapsed *1e9;
+    cout << "Time is up! sessions: " << num_sessions << " bw: " << std::fixed << bw
+         << " latency(us) p50: " << percentile(0.5) << " p99: " << percentile(0.99)
+         << " max: " << percentile(1.0) << endl;
+
+    std::ofstream file;
+    file.open("results/bw_" + std::to_string(node_rank) + ".txt");
+    file << std::fixed << bw << endl;
+    file.close();
+
+    file.open("results/latency_" + std::to_string(node_rank) + ".txt");
+    file << num_sessions << " " << percentile(0.5) << " " << percentile(0.99) << " " << percentile(1.0) << endl;
+    file.close();
+
+    group.barrier_sync();
+    group.leave();
+    return 0;
+}
@@ -0,0 +1,205 @@
+/**
+ * @file virtual_clients.hpp
+ *
+ * A small runtime that multiplexes many logical client sessions, written as
+ * C++20 coroutines, over a few OS threads. A session co_awaits either a think
+ * time or the replies to an ordered_send; while it waits, its thread runs
+ * other sessions. Derecho's QueryResults has no completion callback, so each
+ * worker polls the replies its suspended sessions are waiting for.
+ */
+
+#pragma once
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <queue>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <derecho/core/derecho.hpp>
+
+namespace virtual_clients {
+
+using clock = std::chrono::steady_clock;
+
+class Scheduler;
+
+/**
+ * The coroutine type of a session. It starts suspended and is resumed only by
+ * the Scheduler it was spawned on; its frame is destroyed when it finishes.
+ */
+struct Session {
+    struct promise_type {
+        Session get_return_object() {
+            return Session{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void();
+        void unhandled_exception() { std::terminate(); }
+
+        Scheduler* scheduler = nullptr;
+    };
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+/**
+ * One worker thread and the sessions it owns. Sessions never migrate between
+ * workers, so none of the queues below need locking once the worker starts.
+ */
+class Scheduler {
+    struct Timer {
+        clock::time_point wake_time;
+        std::coroutine_handle<> handle;
+        bool operator>(const Timer& other) const {
+            return wake_time > other.wake_time;
+        }
+    };
+    struct Waiter {
+        std::function<bool()> is_ready;
+        std::coroutine_handle<> handle;
+    };
+
+    std::deque<std::coroutine_handle<>> ready;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers;
+    std::vector<Waiter> waiters;
+    std::size_t num_live = 0;
+
+public:
+    void spawn(Session session) {
+        session.handle.promise().scheduler = this;
+        ready.push_back(session.handle);
+        ++num_live;
+    }
+
+    void sleep_until(clock::time_point wake_time, std::coroutine_handle<> handle) {
+        timers.push({wake_time, handle});
+    }
+
+    void wait_until(std::function<bool()> is_ready, std::coroutine_handle<> handle) {
+        waiters.push_back({std::move(is_ready), handle});
+    }
+
+    void on_session_done() {
+        --num_live;
+    }
+
+    /**
+     * Runs sessions until all of them have finished.
+     */
+    void run() {
+        while(num_live > 0) {
+            auto now = clock::now();
+            while(!timers.empty() && timers.top().wake_time <= now) {
+                ready.push_back(timers.top().handle);
+                timers.pop();
+            }
+            for(std::size_t i = 0; i < waiters.size();) {
+                if(waiters[i].is_ready()) {
+                    ready.push_back(waiters[i].handle);
+                    waiters[i] = std::move(waiters.back());
+                    waiters.pop_back();
+                } else {
+                    ++i;
+                }
+            }
+            // only resume what was ready on entry, so timers and replies keep being polled
+            for(std::size_t n = ready.size(); n > 0; --n) {
+                auto handle = ready.front();
+                ready.pop_front();
+                handle.resume();
+            }
+            if(ready.empty() && waiters.empty() && !timers.empty()) {
+                std::this_thread::sleep_until(timers.top().wake_time);
+            }
+        }
+    }
+};
+
+inline void Session::promise_type::return_void() {
+    scheduler->on_session_done();
+}
+
+/**
+ * Awaitable that suspends the session for the given duration.
+ */
+struct SleepFor {
+    Scheduler& scheduler;
+    clock::duration duration;
+
+    bool await_ready() const { return duration <= clock::duration::zero(); }
+    void await_suspend(std::coroutine_handle<> handle) {
+        scheduler.sleep_until(clock::now() + duration, handle);
+    }
+    void await_resume() {}
+};
+
+/**
+ * Awaitable that suspends the session until every member of the shard has
+ * replied to an ordered_send.
+ */
+template <typename T>
+struct AllReplies {
+    Scheduler& scheduler;
+    derecho::rpc::QueryResults<T>& results;
+
+    bool is_ready() {
+        auto reply_map = results.wait(std::chrono::nanoseconds(0));
+        if(!reply_map) {
+            return false;
+        }
+        for(auto& reply_pair : reply_map->get()) {
+            if(reply_pair.second.wait_for(std::chrono::nanoseconds(0)) != std::future_status::ready) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool await_ready() { return is_ready(); }
+    void await_suspend(std::coroutine_handle<> handle) {
+        scheduler.wait_until([this]() { return is_ready(); }, handle);
+    }
+    void await_resume() {}
+};
+
+/**
+ * Runs one Scheduler per thread and distributes sessions round-robin.
+ */
+class Runtime {
+    std::vector<Scheduler> schedulers;
+    std::size_t next = 0;
+
+public:
+    Runtime(std::size_t num_threads) : schedulers(num_threads) {}
+
+    /**
+     * Creates a session on the next scheduler.
+     * @param make_session Called with the session's scheduler; returns the coroutine
+     */
+    void spawn(const std::function<Session(Scheduler&)>& make_session) {
+        Scheduler& scheduler = schedulers[next++ % schedulers.size()];
+        scheduler.spawn(make_session(scheduler));
+    }
+
+    /**
+     * Runs all sessions to completion, blocking the calling thread.
+     */
+    void run() {
+        std::vector<std::thread> threads;
+        for(Scheduler& scheduler : schedulers) {
+            threads.emplace_back([&scheduler]() { scheduler.run(); });
+        }
+        for(std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+};
+
+}  // namespace virtual_clients